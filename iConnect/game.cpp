@@ -0,0 +1,317 @@
+#include <vector>
+#include <cstdlib>
+#include "game.h"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void initGame(Game &game, int nRows, int nCols, int nSquares, unsigned seed){
+    for (int i=0; i<nRows; i++){
+        for (int j=0; j<nCols; j++){
+            game.cells[i][j]=(Cell) {0, CELL_EATEN};
+        }
+    }
+    game.seed    = mixSeed(seed);
+    randomSquares(game.cells, game.seed);
+    game.nRows   = nRows;
+    game.nCols   = nCols;
+    game.nEaten  = 0;
+    game.lastPos = (CellPos) {0, 0};
+    game.state   = GAME_PLAYING;
+    game.nPts    = 0;
+}
+
+void randomSquares(Table &cells, unsigned &seed){
+    int maxVal=(DEFAULT_ROWS-2)*(DEFAULT_COLS-2),
+        nSquares=DEFAULT_SQUARES;
+    vector<int> num(nSquares, 0);
+    for (int i=0; i<nSquares; i++){
+        if (i==nSquares-1){
+            num[i]=maxVal;
+        } else {
+        num[i]=(maxVal)/(nSquares-i);
+        maxVal-=num[i];
+        }
+    }
+    int value;
+    for (int i=1; i<DEFAULT_ROWS-1; i++){
+        for (int j=1; j<DEFAULT_COLS-1; j++){
+            do {
+                value=nextRandom(seed)%nSquares+1;
+            } while (num[value-1]==0);
+            num[value-1]--;
+            cells[i][j].value=value;
+            cells[i][j].state=CELL_WHITE;
+        }
+    }
+}
+
+/// Giống rand() nhưng trạng thái nằm trong ván, nên nhiều luồng dùng cùng lúc không phải tranh khoá chung
+int nextRandom(unsigned &seed){
+    seed = seed*1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+/// Các seed liền nhau (time(0), số đếm) cho ra dãy gần giống nhau, nên trộn đều các bit trước khi dùng
+unsigned mixSeed(unsigned seed){
+    seed ^= seed >> 16;
+    seed *= 0x7feb352d;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68b;
+    seed ^= seed >> 16;
+    return seed;
+}
+
+bool canSelect(Game &game, CellPos &pos){
+    if (game.state != GAME_PLAYING) return false;
+    if (pos.i<1 || pos.i>game.nRows-2 || pos.j<1 || pos.j>game.nCols-2) return false;
+    return game.cells[pos.i][pos.j].state == CELL_WHITE;
+}
+
+MoveResult processGame(Game &game, CellPos &pos){
+    int rows=DEFAULT_ROWS-2;
+    int cols=DEFAULT_COLS-2;
+    bool check=false;
+    for (int i1=1; i1<=rows && !check; i1++){
+    for (int j1=1; j1<=cols && !check; j1++){
+        for (int i2=1; i2<=rows && !check; i2++){
+        for (int j2=1; j2<=cols && !check; j2++){
+            if ( (i1 != i2 || j1 != j2) && (game.cells[i1][j1].state == CELL_WHITE && game.cells[i2][j2].state == CELL_WHITE) ){
+                game.cells[i1][j1].state = CELL_BLACK;
+                game.cells[i2][j2].state = CELL_BLACK;
+                CellPos pos1 = (CellPos) {i1, j1};
+                CellPos pos2 = (CellPos) {i2, j2};
+                if (checkGame(game, pos1, pos2) == true) {
+                    game.nPts = 0;
+                    check=true;
+                }
+                game.cells[i1][j1].state = CELL_WHITE;
+                game.cells[i2][j2].state = CELL_WHITE;
+            }
+        }
+        }
+    }
+    }
+    if (!check) resetGame(game.cells, game.seed);
+
+
+    int maxVal=(game.nRows-2)*(game.nCols-2);
+    CellPos last = game.lastPos;
+    game.cells[pos.i][pos.j].state = CELL_BLACK;
+    if (last.i == 0) {
+        game.lastPos = pos;
+        return MOVE_SELECTED;
+    }
+
+    MoveResult result;
+    if (checkGame(game, last, pos)) {
+        game.cells[last.i][last.j].state = CELL_EATEN;
+        game.cells[pos.i][pos.j].state = CELL_EATEN;
+        game.nEaten+=2;
+        result = MOVE_CORRECT;
+    }
+    else {
+        game.cells[last.i][last.j].state = CELL_WHITE;
+        game.cells[pos.i][pos.j].state = CELL_WHITE;
+        result = MOVE_INCORRECT;
+    }
+
+    game.lastPos.i=0;
+    if (game.nEaten == maxVal){
+        game.state=GAME_WON;
+    }
+    return result;
+}
+
+bool checkGame(Game &game, CellPos &pos1, CellPos &pos2){
+    game.nPts = 0;
+    if (game.cells[pos1.i][pos1.j].value != game.cells[pos2.i][pos2.j].value) {
+        return false;
+    }
+    if (check1Line(game.cells, pos1, pos2)){
+        game.pts[game.nPts++] = getPoint(pos1.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos2.j);
+        return true;
+    }
+
+    if (check2Lines(game.cells, pos1, pos2) == 1){
+        game.pts[game.nPts++] = getPoint(pos1.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(pos1.i, pos2.j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos2.j);
+        return true;
+    }
+
+    if (check2Lines(game.cells, pos1, pos2) == 2){
+        game.pts[game.nPts++] = getPoint(pos1.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos2.j);
+        return true;
+    }
+
+    int j=check3LinesX(game.cells, pos1, pos2);
+    if (j!=-1) {
+        game.pts[game.nPts++] = getPoint(pos1.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(pos1.i, j);
+        game.pts[game.nPts++] = getPoint(pos2.i, j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos2.j);
+        return true;
+    }
+
+    int i=check3LinesY(game.cells, pos1, pos2);
+    if (i!=-1) {
+        game.pts[game.nPts++] = getPoint(pos1.i, pos1.j);
+        game.pts[game.nPts++] = getPoint(i, pos1.j);
+        game.pts[game.nPts++] = getPoint(i, pos2.j);
+        game.pts[game.nPts++] = getPoint(pos2.i, pos2.j);
+        return true;
+    }
+
+    return false;
+}
+
+CellPos getPoint(int &i, int &j){
+    CellPos point;
+    point.i = j*52+26;
+    point.j = i*52+26+30;
+    return point;
+}
+
+/// Đi theo đường chữ I
+bool check1Line(Table &cells, CellPos &pos1, CellPos &pos2){
+    if (pos1.i != pos2.i && pos1.j != pos2.j) return false;
+
+    if (pos1.i==pos2.i){
+        int i=pos1.i;
+        if (pos1.j<pos2.j){
+            for (int j=pos1.j; j<=pos2.j; j++){
+                if (cells[i][j].state == CELL_WHITE ) return false;
+            }
+            return true;
+        }
+        else {
+            for (int j=pos2.j; j<=pos1.j; j++){
+                if (cells[i][j].state == CELL_WHITE) return false;
+            }
+            return true;
+        }
+    }
+
+    if (pos1.j==pos2.j){
+        int j=pos1.j;
+        if (pos1.i<pos2.i){
+            for (int i=pos1.i; i<=pos2.i; i++){
+                if (cells[i][j].state == CELL_WHITE) return false;
+            }
+            return true;
+        }
+        else {
+            for (int i=pos2.i; i<=pos1.i; i++){
+                if (cells[i][j].state == CELL_WHITE) return false;
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+/// Đi theo đường chữ L
+int check2Lines(Table &cells, CellPos &pos1, CellPos &pos2){
+    CellPos point1 = (CellPos) {pos1.i, pos2.j},
+            point2 = (CellPos) {pos2.i, pos1.j};
+    if (check1Line(cells, pos1, point1) && check1Line(cells, pos2, point1)) return 1;
+    if (check1Line(cells, pos1, point2) && check1Line(cells, pos2, point2)) return 2;
+    return -1;
+}
+
+/// Đi theo đường chữ Z hoặc U
+int check3LinesX(Table &cells, CellPos &pos1, CellPos &pos2){
+    CellPos pMax=pos1,
+            pMin=pos2;
+    if (pos1.j<pos2.j){
+        pMax=pos2;
+        pMin=pos1;
+    }
+
+    for (int j=pMin.j+1; j<pMax.j; j++){               // Đi chữ Z
+        CellPos point1=(CellPos) {pMin.i, j},
+                point2=(CellPos) {pMax.i, j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return j;
+    }
+
+    for (int j=pMin.j-1; j>=0; j--){                    // Đi chữ U
+        CellPos point1=(CellPos) {pMin.i, j},
+                point2=(CellPos) {pMax.i, j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return j;
+    }
+    for (int j=pMax.j+1; j<DEFAULT_COLS; j++){          // Đi chữ U
+        CellPos point1=(CellPos) {pMin.i, j},
+                point2=(CellPos) {pMax.i, j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return j;
+    }
+    return -1;
+}
+
+int check3LinesY(Table &cells, CellPos &pos1, CellPos &pos2){
+    CellPos pMax=pos1,
+            pMin=pos2;
+    if (pos1.i<pos2.i){
+        pMax=pos2;
+        pMin=pos1;
+    }
+
+    for (int i=pMin.i+1; i<pMax.i; i++){               // Đi chữ Z
+        CellPos point1=(CellPos) {i, pMin.j},
+                point2=(CellPos) {i, pMax.j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return i;
+    }
+
+    for (int i=pMin.i-1; i>=0; i--){                    // Đi chữ U
+        CellPos point1=(CellPos) {i, pMin.j},
+                point2=(CellPos) {i, pMax.j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return i;
+    }
+    for (int i=pMax.i+1; i<DEFAULT_ROWS; i++){          // Đi chữ U
+        CellPos point1=(CellPos) {i, pMin.j},
+                point2=(CellPos) {i, pMax.j};
+        if (check1Line(cells, pMin, point1) &&
+            check1Line(cells, point1, point2) &&
+            check1Line(cells, point2, pMax)) return i;
+    }
+    return -1;
+}
+
+void resetGame(Table &cells, unsigned &seed){
+    vector<int> num(DEFAULT_SQUARES, 0);
+    for (int i=1; i<DEFAULT_ROWS-1; i++){
+        for (int j=1; j<DEFAULT_COLS-1; j++){
+            if (cells[i][j].state == CELL_WHITE){
+                num[cells[i][j].value-1]++;
+            }
+        }
+    }
+
+    int value,
+        nSquares=DEFAULT_SQUARES;
+    for (int i=1; i<DEFAULT_ROWS-1; i++){
+        for (int j=1; j<DEFAULT_COLS-1; j++){
+            if (cells[i][j].state == CELL_WHITE){
+                do {
+                    value=nextRandom(seed)%nSquares+1;
+                } while (num[value-1]==0);
+                num[value-1]--;
+                cells[i][j].value=value;
+            }
+        }
+    }
+}
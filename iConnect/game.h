@@ -0,0 +1,70 @@
+#ifndef GAME_H
+#define GAME_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int DEFAULT_ROWS              =10;
+const int DEFAULT_COLS              =10;
+const int DEFAULT_SQUARES           =8;
+
+enum CellState {
+    CELL_WHITE,
+    CELL_BLACK,
+    CELL_EATEN
+};
+
+enum GameState {
+    GAME_PLAYING,
+    GAME_WON
+};
+
+enum MoveResult {
+    MOVE_SELECTED,
+    MOVE_CORRECT,
+    MOVE_INCORRECT
+};
+
+struct Cell {
+    int value;
+    CellState state;
+};
+
+typedef Cell Table[DEFAULT_ROWS][DEFAULT_COLS];           // Một khối liền, không cấp phát
+
+struct CellPos {
+    int i;
+    int j;
+};
+
+struct Game {
+    int nRows;
+    int nCols;
+    int nEaten;
+    Table cells;
+    CellPos lastPos;
+    GameState state;
+    CellPos pts[4];                                 // Đường nối của cặp ô vừa ăn, tối đa 4 điểm
+    int nPts;
+    unsigned seed;                                  // Bộ sinh số ngẫu nhiên riêng của ván
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Phần luật chơi, không phụ thuộc SDL: dùng chung cho cửa sổ game và server.
+void initGame(Game &Game, int nRows, int nCols, int nSquare, unsigned seed);
+void randomSquares(Table &cells, unsigned &seed);
+int nextRandom(unsigned &seed);
+unsigned mixSeed(unsigned seed);
+
+bool canSelect(Game &game, CellPos &pos);
+MoveResult processGame(Game &game, CellPos &pos);
+void resetGame(Table&, unsigned&);
+
+bool checkGame(Game&, CellPos&, CellPos&);
+CellPos getPoint(int&, int&);
+bool check1Line(Table&, CellPos&, CellPos&);
+int  check2Lines(Table&, CellPos&, CellPos&);
+int check3LinesX(Table&, CellPos&, CellPos&);
+int check3LinesY(Table&, CellPos&, CellPos&);
+
+#endif // GAME_H
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <time.h>
+#include "latency.h"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long nowNs(){
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+void initLatency(Latency &lat){
+    lat.count = 0;
+    lat.sumNs = 0;
+    lat.maxNs = 0;
+    for (int i=0; i<LATENCY_BUCKETS; i++){
+        lat.buckets[i] = 0;
+    }
+}
+
+void recordLatency(Latency &lat, unsigned long long ns){
+    lat.buckets[latencyBucket(ns/1000)].fetch_add(1, memory_order_relaxed);
+    lat.count.fetch_add(1, memory_order_relaxed);
+    lat.sumNs.fetch_add(ns, memory_order_relaxed);
+    if (ns > lat.maxNs.load(memory_order_relaxed)){
+        lat.maxNs.store(ns, memory_order_relaxed);
+    }
+}
+
+int latencyBucket(unsigned long long us){
+    if (us < (unsigned long long) LATENCY_LINEAR) return us;
+    int k = 63 - __builtin_clzll(us);
+    return LATENCY_LINEAR + (k-6)*LATENCY_SUB + ((us >> (k-5)) & (LATENCY_SUB-1));
+}
+
+/// Giới hạn trên (không tính) của một ô, tính bằng micro giây
+unsigned long long bucketLimitUs(int bucket){
+    if (bucket < LATENCY_LINEAR) return bucket+1;
+    int k   = (bucket-LATENCY_LINEAR)/LATENCY_SUB + 6,
+        sub = (bucket-LATENCY_LINEAR)%LATENCY_SUB;
+    return (1ULL << k) + ((unsigned long long) (sub+1) << (k-5));
+}
+
+void clearReport(LatencyReport &report){
+    report.count = 0;
+    report.sumNs = 0;
+    report.maxNs = 0;
+    for (int i=0; i<LATENCY_BUCKETS; i++){
+        report.buckets[i] = 0;
+    }
+}
+
+/// Cộng dồn số liệu của một luồng vào báo cáo rồi xoá bộ đếm của luồng đó
+void collectLatency(Latency &lat, LatencyReport &report){
+    report.count += lat.count.exchange(0, memory_order_relaxed);
+    report.sumNs += lat.sumNs.exchange(0, memory_order_relaxed);
+    unsigned long long maxNs = lat.maxNs.exchange(0, memory_order_relaxed);
+    if (maxNs > report.maxNs) report.maxNs = maxNs;
+    for (int i=0; i<LATENCY_BUCKETS; i++){
+        report.buckets[i] += lat.buckets[i].exchange(0, memory_order_relaxed);
+    }
+}
+
+void mergeReport(LatencyReport &total, const LatencyReport &report){
+    total.count += report.count;
+    total.sumNs += report.sumNs;
+    if (report.maxNs > total.maxNs) total.maxNs = report.maxNs;
+    for (int i=0; i<LATENCY_BUCKETS; i++){
+        total.buckets[i] += report.buckets[i];
+    }
+}
+
+double percentileUs(const LatencyReport &report, double p){
+    if (report.count == 0) return 0;
+    unsigned long long target = (unsigned long long) (report.count*p);
+    unsigned long long seen = 0;
+    for (int i=0; i<LATENCY_BUCKETS; i++){
+        seen += report.buckets[i];
+        if (seen > target) return bucketLimitUs(i);
+    }
+    return bucketLimitUs(LATENCY_BUCKETS-1);
+}
+
+void printReport(const string &name, const LatencyReport &report, double seconds, const string &extra){
+    double avg = report.count ? report.sumNs/1000.0/report.count : 0;
+    printf("[%s] %.0f moves/s | latency avg %.1fus p50 <%.0fus p99 <%.0fus max %.1fus%s\n",
+           name.c_str(),
+           seconds > 0 ? report.count/seconds : 0,
+           avg,
+           percentileUs(report, 0.50),
+           percentileUs(report, 0.99),
+           report.maxNs/1000.0,
+           extra.c_str());
+    fflush(stdout);
+}
@@ -0,0 +1,44 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int LATENCY_LINEAR            =64;            // Dưới 64us mỗi ô rộng 1us
+const int LATENCY_SUB               =32;            // Từ đó mỗi khoảng [2^k, 2^(k+1)) chia 32 ô
+const int LATENCY_BUCKETS           =LATENCY_LINEAR + 58*LATENCY_SUB;
+
+/// Bộ đếm của một luồng: chỉ luồng đó ghi, luồng báo cáo đọc và xoá.
+struct Latency {
+    std::atomic<unsigned long long> count;
+    std::atomic<unsigned long long> sumNs;
+    std::atomic<unsigned long long> maxNs;
+    std::atomic<unsigned long long> buckets[LATENCY_BUCKETS];
+};
+
+struct LatencyReport {
+    unsigned long long count;
+    unsigned long long sumNs;
+    unsigned long long maxNs;
+    unsigned long long buckets[LATENCY_BUCKETS];
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long nowNs();
+
+void initLatency(Latency &lat);
+void recordLatency(Latency &lat, unsigned long long ns);
+
+int latencyBucket(unsigned long long us);
+unsigned long long bucketLimitUs(int bucket);
+
+void clearReport(LatencyReport &report);
+void collectLatency(Latency &lat, LatencyReport &report);
+void mergeReport(LatencyReport &total, const LatencyReport &report);
+double percentileUs(const LatencyReport &report, double p);
+void printReport(const std::string &name, const LatencyReport &report, double seconds, const std::string &extra = "");
+
+#endif // LATENCY_H
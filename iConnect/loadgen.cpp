@@ -0,0 +1,397 @@
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "game.h"
+#include "latency.h"
+
+using namespace std;
+
+/// Máy tạo tải cho server: mỗi kết nối chơi liên tục một ván, tự tìm cặp ô ăn được bằng chính checkGame
+/// rồi gửi hai lệnh MOVE. Thời gian đo ở đây là thời gian khứ hồi của mỗi lệnh MOVE.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const string DEFAULT_HOST           = "127.0.0.1";
+const int DEFAULT_PORT              =5050;
+const int DEFAULT_CLIENTS           =1000;
+const int DEFAULT_THREADS           =2;
+const int DEFAULT_SECONDS           =10;
+const int MAX_EVENTS                =256;
+const int REQUEST_TIMEOUT           =2000;          // ms, quá thời gian này mà chưa có trả lời thì tính là lỗi
+
+enum ClientStep {
+    STEP_NEW,
+    STEP_BOARD,
+    STEP_MOVE1,
+    STEP_MOVE2,
+    STEP_END
+};
+
+struct Client {
+    int fd;
+    int id;
+    ClientStep step;
+    CellPos pos1;
+    CellPos pos2;
+    Game game;
+    string in;
+    unsigned long long sentAt;
+    bool alive;
+};
+
+struct Target {
+    string host;
+    int port;
+    string unixPath;
+};
+
+struct LoadThread {
+    int epfd;
+    vector<Client*> clients;
+    Latency latency;
+    atomic<unsigned long long> nWon;
+    atomic<unsigned long long> nErrors;
+};
+
+atomic<bool> stopLoad(false);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void raiseFileLimit();
+int connectTarget(const Target &target);
+void runLoad(LoadThread *t);
+void dropClient(LoadThread &t, Client &c, const char *reason);
+void sendLine(Client &c, const string &line);
+void handleReply(LoadThread &t, Client &c, const char *line);
+bool readBoard(Game &game, const char *line);
+void choosePair(Game &game, CellPos &pos1, CellPos &pos2);
+string moveLine(Client &c, CellPos &pos);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]){
+    Target target = {DEFAULT_HOST, DEFAULT_PORT, ""};
+    int nClients = DEFAULT_CLIENTS,
+        nThreads = DEFAULT_THREADS,
+        seconds  = DEFAULT_SECONDS;
+
+    for (int i=1; i<argc; i++){
+        string arg = argv[i];
+        if (arg == "-h" && i+1<argc)      target.host = argv[++i];
+        else if (arg == "-p" && i+1<argc) target.port = atoi(argv[++i]);
+        else if (arg == "-u" && i+1<argc) target.unixPath = argv[++i];
+        else if (arg == "-c" && i+1<argc) nClients = atoi(argv[++i]);
+        else if (arg == "-t" && i+1<argc) nThreads = atoi(argv[++i]);
+        else if (arg == "-d" && i+1<argc) seconds = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Cách dùng: %s [-h máy] [-p cổng | -u đường_dẫn_socket] [-c số_kết_nối] [-t số_luồng] [-d số_giây]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (nThreads < 1) nThreads = 1;
+    if (nClients < 1) nClients = 1;
+    raiseFileLimit();
+
+    vector<LoadThread*> threads;
+    for (int i=0; i<nThreads; i++){
+        LoadThread *t = new LoadThread;
+        t->epfd    = epoll_create1(0);
+        t->nWon    = 0;
+        t->nErrors = 0;
+        initLatency(t->latency);
+        threads.push_back(t);
+    }
+
+    int nConnected = 0;
+    for (int i=0; i<nClients; i++){
+        int fd = connectTarget(target);
+        if (fd < 0){
+            fprintf(stderr, "Lỗi: chỉ kết nối được %d/%d (%s)\n", i, nClients, strerror(errno));
+            if (i == 0) return EXIT_FAILURE;
+            break;
+        }
+        LoadThread *t = threads[i % nThreads];
+        Client *c = new Client;
+        c->fd    = fd;
+        c->id    = -1;
+        c->step  = STEP_NEW;
+        c->alive = true;
+        t->clients.push_back(c);
+        nConnected++;
+
+        epoll_event ev;
+        ev.events   = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(t->epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    vector<thread> workers;
+    for (int i=0; i<nThreads; i++){
+        workers.push_back(thread(runLoad, threads[i]));
+    }
+
+    LatencyReport total;
+    clearReport(total);
+    unsigned long long start = nowNs(), last = start;
+    for (int s=0; s<seconds; s++){
+        sleep(1);
+        LatencyReport report;
+        clearReport(report);
+        for (int i=0; i<nThreads; i++){
+            collectLatency(threads[i]->latency, report);
+        }
+        unsigned long long now = nowNs();
+        printReport("loadgen", report, (now-last)/1e9);
+        mergeReport(total, report);
+        last = now;
+    }
+
+    stopLoad = true;
+    unsigned long long nWon = 0, nErrors = 0;
+    for (int i=0; i<nThreads; i++){
+        workers[i].join();
+        nWon    += threads[i]->nWon;
+        nErrors += threads[i]->nErrors;
+        collectLatency(threads[i]->latency, total);         // Các nước đi sau lần báo cáo cuối
+    }
+    last = nowNs();
+
+    int nAlive = 0;
+    for (int i=0; i<nThreads; i++){
+        for (int j=0; j<(int) threads[i]->clients.size(); j++){
+            if (threads[i]->clients[j]->alive) nAlive++;
+        }
+    }
+    printf("[loadgen] Tổng kết: %d/%d kết nối, %d còn chơi tới cuối, %llu nước đi, %llu ván thắng, %llu lỗi\n",
+           nConnected, nClients, nAlive, total.count, nWon, nErrors);
+    printReport("loadgen", total, (last-start)/1e9);
+    return nErrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void raiseFileLimit(){
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_cur == lim.rlim_max) return;
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+}
+
+int connectTarget(const Target &target){
+    int fd;
+    if (target.unixPath.empty()){
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(target.port);
+        if (inet_pton(AF_INET, target.host.c_str(), &addr.sin_addr) != 1 ||
+            connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            close(fd);
+            return -1;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    else {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, target.unixPath.c_str(), sizeof(addr.sun_path)-1);
+        if (connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/// Mỗi kết nối chỉ có một lệnh đang chờ trả lời nên gửi thẳng, không cần hàng đợi ghi
+void runLoad(LoadThread *t){
+    for (int i=0; i<(int) t->clients.size(); i++){
+        sendLine(*t->clients[i], "NEW");
+    }
+
+    epoll_event events[MAX_EVENTS];
+    char buf[4096];
+    while (!stopLoad){
+        int n = epoll_wait(t->epfd, events, MAX_EVENTS, 100);
+        for (int k=0; k<n; k++){
+            Client &c = *(Client*) events[k].data.ptr;
+            ssize_t len = recv(c.fd, buf, sizeof(buf), 0);
+            if (len <= 0){
+                if (len < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                dropClient(*t, c, len == 0 ? "server đóng kết nối" : strerror(errno));
+                continue;
+            }
+            c.in.append(buf, len);
+
+            size_t end = c.in.find('\n');
+            if (end == string::npos) continue;
+            c.in[end] = '\0';
+            handleReply(*t, c, c.in.c_str());
+            c.in.erase(0, end+1);
+        }
+
+        unsigned long long now = nowNs();
+        for (int i=0; i<(int) t->clients.size(); i++){
+            Client &c = *t->clients[i];
+            if (c.alive && now - c.sentAt > REQUEST_TIMEOUT*1000000ULL){
+                dropClient(*t, c, "quá thời gian chờ trả lời");
+            }
+        }
+    }
+
+    for (int i=0; i<(int) t->clients.size(); i++){
+        close(t->clients[i]->fd);
+    }
+}
+
+/// Kết nối hỏng hoặc server không trả lời: tính một lỗi và thôi theo dõi kết nối đó
+void dropClient(LoadThread &t, Client &c, const char *reason){
+    if (!c.alive) return;
+    if (t.nErrors == 0) fprintf(stderr, "[loadgen] Mất kết nối: %s\n", reason);
+    t.nErrors++;
+    c.alive = false;
+    epoll_ctl(t.epfd, EPOLL_CTL_DEL, c.fd, NULL);
+}
+
+void sendLine(Client &c, const string &line){
+    string msg = line + "\n";
+    c.sentAt = nowNs();
+    if (send(c.fd, msg.data(), msg.size(), MSG_NOSIGNAL) != (ssize_t) msg.size()){
+        fprintf(stderr, "Lỗi: gửi lệnh thất bại (%s)\n", strerror(errno));
+    }
+}
+
+void handleReply(LoadThread &t, Client &c, const char *line){
+    if (strncmp(line, "ERROR", 5) == 0){
+        t.nErrors++;
+        fprintf(stderr, "[loadgen] server trả lời: %s\n", line);
+        c.step = STEP_NEW;
+        sendLine(c, "NEW");
+        return;
+    }
+
+    switch (c.step){
+    case STEP_NEW:
+        c.id = atoi(line+5);
+        c.step = STEP_BOARD;
+        sendLine(c, "BOARD " + to_string(c.id));
+        break;
+
+    case STEP_BOARD:
+        if (!readBoard(c.game, line)){
+            t.nErrors++;
+            sendLine(c, "BOARD " + to_string(c.id));
+            break;
+        }
+        choosePair(c.game, c.pos1, c.pos2);
+        c.step = STEP_MOVE1;
+        sendLine(c, moveLine(c, c.pos1));
+        break;
+
+    case STEP_MOVE1:
+        recordLatency(t.latency, nowNs()-c.sentAt);
+        if (strcmp(line, "SELECTED") != 0){
+            c.step = STEP_BOARD;
+            sendLine(c, "BOARD " + to_string(c.id));
+            break;
+        }
+        c.step = STEP_MOVE2;
+        sendLine(c, moveLine(c, c.pos2));
+        break;
+
+    case STEP_MOVE2:
+        recordLatency(t.latency, nowNs()-c.sentAt);
+        if (strcmp(line, "WON") == 0){
+            t.nWon++;
+            c.step = STEP_END;
+            sendLine(c, "END " + to_string(c.id));
+            break;
+        }
+        c.step = STEP_BOARD;
+        sendLine(c, "BOARD " + to_string(c.id));
+        break;
+
+    case STEP_END:
+        c.step = STEP_NEW;
+        sendLine(c, "NEW");
+        break;
+    }
+}
+
+bool readBoard(Game &game, const char *line){
+    int nRows, nCols, used;
+    if (sscanf(line, "BOARD %d %d%n", &nRows, &nCols, &used) != 2) return false;
+    if (nRows != DEFAULT_ROWS || nCols != DEFAULT_COLS) return false;
+    line += used;
+
+    game.nRows = nRows;
+    game.nCols = nCols;
+    for (int i=0; i<nRows; i++){
+        for (int j=0; j<nCols; j++){
+            int value;
+            if (sscanf(line, "%d%n", &value, &used) != 1) return false;
+            line += used;
+            Cell &cell = game.cells[i][j];
+            cell.value = value < 0 ? -value : value;
+            cell.state = value > 0 ? CELL_WHITE : value < 0 ? CELL_BLACK : CELL_EATEN;
+        }
+    }
+    return true;
+}
+
+/// Tìm cặp ô ăn được giống cách processGame quét bàn; nếu bí thì chọn đại hai ô trắng
+void choosePair(Game &game, CellPos &pos1, CellPos &pos2){
+    vector<CellPos> whites;
+    for (int i=1; i<game.nRows-1; i++){
+        for (int j=1; j<game.nCols-1; j++){
+            if (game.cells[i][j].state == CELL_WHITE) whites.push_back((CellPos) {i, j});
+        }
+    }
+
+    pos1 = whites.size() > 0 ? whites[0] : (CellPos) {1, 1};
+    pos2 = whites.size() > 1 ? whites[1] : (CellPos) {1, 2};
+    for (int a=0; a<(int) whites.size(); a++){
+        for (int b=a+1; b<(int) whites.size(); b++){
+            CellPos &p1 = whites[a],
+                    &p2 = whites[b];
+            if (game.cells[p1.i][p1.j].value != game.cells[p2.i][p2.j].value) continue;
+            game.cells[p1.i][p1.j].state = CELL_BLACK;
+            game.cells[p2.i][p2.j].state = CELL_BLACK;
+            bool found = checkGame(game, p1, p2);
+            game.cells[p1.i][p1.j].state = CELL_WHITE;
+            game.cells[p2.i][p2.j].state = CELL_WHITE;
+            if (found){
+                pos1 = p1;
+                pos2 = p2;
+                return;
+            }
+        }
+    }
+}
+
+string moveLine(Client &c, CellPos &pos){
+    return "MOVE " + to_string(c.id) + " " + to_string(pos.i) + " " + to_string(pos.j);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
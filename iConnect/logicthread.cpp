@@ -0,0 +1,105 @@
+#include <ctime>
+#include "logicthread.h"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool startLogic(LogicThread &logic, int nRows, int nCols, int nSquares){
+    logic.nRows    = nRows;
+    logic.nCols    = nCols;
+    logic.nSquares = nSquares;
+    initQueue(logic.clicks);
+    initQueue(logic.effects);
+    initSnapshots(logic.snapshots);
+    SDL_AtomicSet(&logic.quit, 0);
+
+    logic.wake = SDL_CreateSemaphore(0);
+    if (logic.wake == NULL) return false;
+    logic.thread = SDL_CreateThread(runLogic, "logic", &logic);
+    if (logic.thread == NULL){
+        SDL_DestroySemaphore(logic.wake);
+        return false;
+    }
+    return true;
+}
+
+void stopLogic(LogicThread &logic){
+    SDL_AtomicSet(&logic.quit, 1);
+    SDL_SemPost(logic.wake);
+    SDL_WaitThread(logic.thread, NULL);
+    SDL_DestroySemaphore(logic.wake);
+}
+
+/// Hàng đợi vẫn không khoá, semaphore chỉ để đánh thức luồng xử lý thay vì để nó chờ vòng
+void sendClick(LogicThread &logic, const CellPos &pos){
+    if (pushQueue(logic.clicks, pos)) SDL_SemPost(logic.wake);
+}
+
+int runLogic(void *data){
+    LogicThread &logic = *(LogicThread*) data;
+    initGame(logic.game, logic.nRows, logic.nCols, logic.nSquares, time(0));
+    publishSnapshot(logic.snapshots, logic.game);
+
+    CellPos pos;
+    while (SDL_AtomicGet(&logic.quit) == 0){
+        if (!popQueue(logic.clicks, pos)){
+            SDL_SemWaitTimeout(logic.wake, LOGIC_WAIT_TIMEOUT);
+            continue;
+        }
+        if (!canSelect(logic.game, pos)) continue;
+
+        MoveResult result = processGame(logic.game, pos);
+        int seq = publishSnapshot(logic.snapshots, logic.game);
+        if (result == MOVE_SELECTED) continue;
+
+        MoveEffect effect;
+        effect.result = result;
+        effect.seq    = seq;
+        effect.nPts   = 0;
+        for (int i=0; i<logic.game.nPts; i++){
+            effect.pts[effect.nPts++] = logic.game.pts[i];
+        }
+        pushQueue(logic.effects, effect);           // Luồng vẽ bị chậm thì bỏ qua hiệu ứng
+    }
+    return 0;
+}
+
+void initSnapshots(SnapshotBuffer &buf){
+    for (int i=0; i<3; i++){
+        buf.slots[i].nRows  = 0;
+        buf.slots[i].nCols  = 0;
+        buf.slots[i].nEaten = 0;
+        buf.slots[i].nPts   = 0;
+        buf.slots[i].state  = GAME_PLAYING;
+        buf.seq[i]          = 0;
+    }
+    buf.nPublished = 0;
+    buf.back  = 0;
+    buf.front = 1;
+    SDL_AtomicSet(&buf.middle, 2);
+}
+
+/// Chép bàn cờ vào back rồi đổi back với middle; bản đã công bố không bị ghi lại cho tới khi luồng vẽ trả về.
+/// Luồng vẽ chỉ đọc bản chụp, đường nối được truyền riêng cho drawTable.
+int publishSnapshot(SnapshotBuffer &buf, const Game &game){
+    int seq = ++buf.nPublished;
+    Game &back = buf.slots[buf.back];
+    back = game;
+    back.nPts = 0;
+    buf.seq[buf.back] = seq;
+    SDL_MemoryBarrierRelease();                     // Bản chụp phải ghi xong trước khi công bố
+    buf.back = SDL_AtomicSet(&buf.middle, buf.back | SNAPSHOT_DIRTY) & ~SNAPSHOT_DIRTY;
+    SDL_MemoryBarrierAcquire();                     // Luồng vẽ đã đọc xong ô vừa nhận lại
+    return seq;
+}
+
+const Game& latestSnapshot(SnapshotBuffer &buf, int &seq){
+    if (SDL_AtomicGet(&buf.middle) & SNAPSHOT_DIRTY){
+        SDL_MemoryBarrierRelease();                 // Đọc xong front cũ rồi mới trả lại
+        buf.front = SDL_AtomicSet(&buf.middle, buf.front) & ~SNAPSHOT_DIRTY;
+        SDL_MemoryBarrierAcquire();                 // Thấy chỉ số mới rồi mới đọc bản chụp
+    }
+    seq = buf.seq[buf.front];
+    return buf.slots[buf.front];
+}
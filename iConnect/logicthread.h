@@ -0,0 +1,95 @@
+#ifndef LOGICTHREAD_H
+#define LOGICTHREAD_H
+
+#include <SDL.h>
+#include "game.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int CLICK_QUEUE_SIZE          =64;            // Phải là lũy thừa của 2
+const int EFFECT_QUEUE_SIZE         =16;
+const int SNAPSHOT_DIRTY            =4;             // Bit đánh dấu ảnh chụp mới chưa được lấy
+const int LOGIC_WAIT_TIMEOUT        =100;           // ms, chỉ để phòng lỡ tín hiệu
+
+/// Hàng đợi một luồng ghi - một luồng đọc, không khoá
+template <typename T, int N>
+struct SpscQueue {
+    T items[N];
+    SDL_atomic_t head;                              // Chỉ luồng đọc thay đổi
+    SDL_atomic_t tail;                              // Chỉ luồng ghi thay đổi
+};
+
+/// Kết quả một nước đi để luồng vẽ phát âm thanh và vẽ đường nối.
+/// Hiệu ứng chỉ là phụ: hàng đợi đầy thì bị bỏ, đường nối chỉ vẽ khi bản chụp đang vẽ đúng là bản của nước đi đó.
+struct MoveEffect {
+    MoveResult result;
+    int seq;                                        // Số thứ tự bản chụp được công bố cùng nước đi
+    int nPts;
+    CellPos pts[4];
+};
+
+/// Ba bản chụp bàn cờ: luồng xử lý ghi vào back, luồng vẽ đọc front, middle là bản vừa được công bố
+struct SnapshotBuffer {
+    Game slots[3];
+    int seq[3];                                     // Số thứ tự của bản chụp trong từng ô
+    int nPublished;                                 // Chỉ luồng xử lý dùng
+    SDL_atomic_t middle;
+    int back;
+    int front;
+};
+
+struct LogicThread {
+    Game game;                                      // Chỉ luồng xử lý được đụng vào
+    int nRows;
+    int nCols;
+    int nSquares;
+    SpscQueue<CellPos, CLICK_QUEUE_SIZE> clicks;
+    SpscQueue<MoveEffect, EFFECT_QUEUE_SIZE> effects;
+    SnapshotBuffer snapshots;
+    SDL_atomic_t quit;
+    SDL_sem *wake;                                  // Báo có lượt bấm mới hoặc cần dừng
+    SDL_Thread *thread;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool startLogic(LogicThread &logic, int nRows, int nCols, int nSquares);
+void stopLogic(LogicThread &logic);
+void sendClick(LogicThread &logic, const CellPos &pos);
+int runLogic(void *data);
+
+void initSnapshots(SnapshotBuffer &buf);
+int publishSnapshot(SnapshotBuffer &buf, const Game &game);
+const Game& latestSnapshot(SnapshotBuffer &buf, int &seq);
+
+template <typename T, int N>
+void initQueue(SpscQueue<T, N> &q){
+    SDL_AtomicSet(&q.head, 0);
+    SDL_AtomicSet(&q.tail, 0);
+}
+
+/// Ghi phần tử xong mới công bố tail (release); đọc head xong mới ghi đè ô cũ (acquire)
+template <typename T, int N>
+bool pushQueue(SpscQueue<T, N> &q, const T &item){
+    unsigned tail = SDL_AtomicGet(&q.tail);
+    if (tail - (unsigned) SDL_AtomicGet(&q.head) == (unsigned) N) return false;
+    SDL_MemoryBarrierAcquire();
+    q.items[tail % N] = item;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&q.tail, tail+1);
+    return true;
+}
+
+/// Thấy tail mới rồi mới đọc phần tử (acquire); đọc xong mới trả ô lại qua head (release)
+template <typename T, int N>
+bool popQueue(SpscQueue<T, N> &q, T &item){
+    unsigned head = SDL_AtomicGet(&q.head);
+    if (head == (unsigned) SDL_AtomicGet(&q.tail)) return false;
+    SDL_MemoryBarrierAcquire();
+    item = q.items[head % N];
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&q.head, head+1);
+    return true;
+}
+
+#endif // LOGICTHREAD_H
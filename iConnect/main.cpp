@@ -7,6 +7,8 @@
 #include <SDL_ttf.h>
 #include <SDL_mixer.h>
 #include <iostream>
+#include "game.h"
+#include "logicthread.h"
 
 using namespace std;
 
@@ -18,9 +20,7 @@ const int SQUARE_HEIGHT             =50;
 const int WINDOW_SQUARE_WIDTH       =50;
 const int WINDOW_SQUARE_HEIGHT      =50;
 
-const int DEFAULT_ROWS              =10;
-const int DEFAULT_COLS              =10;
-const int DEFAULT_SQUARES           =8;
+const int LINE_TIME                 =500;      // Thời gian hiện đường nối (ms)
 
 const string SCREEN_TITLE           = "iConnect";
 const string SQUARE_WHITE           = "white.jpg";
@@ -33,17 +33,6 @@ const string BGMUSIC                = "FutariNoKimochi.mp3";
 
 
 
-enum CellState {
-    CELL_WHITE,
-    CELL_BLACK,
-    CELL_EATEN
-};
-
-enum GameState {
-    GAME_PLAYING,
-    GAME_WON
-};
-
 enum SquareType{
     BLACK_1,       WHITE_1,
     BLACK_2,       WHITE_2,
@@ -58,28 +47,6 @@ enum SquareType{
     SQUARE_TOTAL
 };
 
-struct Cell {
-    int value;
-    CellState state;
-};
-
-typedef vector<vector<Cell> > Table;
-
-struct CellPos {
-    int i;
-    int j;
-};
-
-struct Game {
-    int nRows;
-    int nCols;
-    int nEaten;
-    Table cells;
-    CellPos lastPos;
-    GameState state;
-    vector <CellPos> pts;
-};
-
 struct Graphic {
     SDL_Window   *window;
     SDL_Texture  *texture;
@@ -113,31 +80,26 @@ SDL_Texture* createTexture(SDL_Renderer* renderer, const string &path);
 void err(const string &mes);
 
 void initRect(vector<SDL_Rect> &rects);
-void initGame(Game &Game, int nRows, int nCols, int nSquare);
-void randomSquares(Table &cells);
 
 void drawText(Text &text, SDL_Renderer *renderer);
 void drawTextWin(Text &text, SDL_Renderer *renderer);
-void drawTable(Game &game, const Graphic &graphic, const vector<SDL_Rect> rects, Text&);
+void drawTable(const Game &game, const Graphic &graphic, const vector<SDL_Rect> rects, Text&, const CellPos *pts, int nPts);
 
 void updateGame(Game &game, const SDL_Event &event, Audio&);
-void processGame(Game &game, CellPos &pos, Audio&);
-void resetGame(Table&);
-
-bool checkGame(Game&, CellPos&, CellPos&);
-CellPos getPoint(int&, int&);
-bool check1Line(Table&, CellPos&, CellPos&);
-int  check2Lines(Table&, CellPos&, CellPos&);
-int check3LinesX(Table&, CellPos&, CellPos&);
-int check3LinesY(Table&, CellPos&, CellPos&);
+bool getCellPos(const SDL_Event &event, CellPos &pos);
+bool runThreaded(const Graphic &graphic, const vector<SDL_Rect> &rects, Text &text, Audio &audio,
+                 int nRows, int nCols, int nSquares);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char* arvg[]){
-    srand(time(0));
     int nRows     = DEFAULT_ROWS,
         nCols     = DEFAULT_COLS,
         nSquares  = DEFAULT_SQUARES;
+    bool threaded = false;
+    for (int i=1; i<argc; i++){
+        if (string(arvg[i]) == "-threaded") threaded = true;
+    }
 
     Graphic graphic;
     Text text;
@@ -151,13 +113,23 @@ int main(int argc, char* arvg[]){
 
     vector<SDL_Rect> rects;
     initRect(rects);
+    if (threaded){
+        bool ok = runThreaded(graphic, rects, text, audio, nRows, nCols, nSquares);
+        finalizeGraphic_Text_Audio(graphic, text, audio);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     Game game;
-    initGame(game, nRows, nCols, nSquares);
+    initGame(game, nRows, nCols, nSquares, time(0));
 
     bool quit=false;
     SDL_Event event;
     while (!quit){
-        drawTable(game, graphic, rects, text);
+        drawTable(game, graphic, rects, text, game.pts, game.nPts);
+        if (game.nPts > 0){
+            SDL_Delay(500);
+            game.nPts = 0;
+        }
 
         while (SDL_PollEvent(&event) != 0){
             if (event.type == SDL_QUIT){
@@ -341,48 +313,7 @@ void initRect(vector<SDL_Rect> &rects){
     }
 }
 
-void initGame(Game &game, int nRows, int nCols, int nSquares){
-    game.cells = Table(nRows, vector<Cell> (nCols));
-    for (int i=0; i<nRows; i++){
-        for (int j=0; j<nCols; j++){
-            game.cells[i][j]=(Cell) {0, CELL_EATEN};
-        }
-    }
-    randomSquares(game.cells);
-    game.nRows   = nRows;
-    game.nCols   = nCols;
-    game.nEaten  = 0;
-    game.lastPos = (CellPos) {0, 0};
-    game.state   = GAME_PLAYING;
-    game.pts.clear();
-}
-
-void randomSquares(Table &cells){
-    int maxVal=(DEFAULT_ROWS-2)*(DEFAULT_COLS-2),
-        nSquares=DEFAULT_SQUARES;
-    vector<int> num(nSquares, 0);
-    for (int i=0; i<nSquares; i++){
-        if (i==nSquares-1){
-            num[i]=maxVal;
-        } else {
-        num[i]=(maxVal)/(nSquares-i);
-        maxVal-=num[i];
-        }
-    }
-    int value;
-    for (int i=1; i<DEFAULT_ROWS-1; i++){
-        for (int j=1; j<DEFAULT_COLS-1; j++){
-            do {
-                value=rand()%nSquares+1;
-            } while (num[value-1]==0);
-            num[value-1]--;
-            cells[i][j].value=value;
-            cells[i][j].state=CELL_WHITE;
-        }
-    }
-}
-
-void drawTable(Game &game, const Graphic &graphic, const vector<SDL_Rect> rects, Text &text) {
+void drawTable(const Game &game, const Graphic &graphic, const vector<SDL_Rect> rects, Text &text, const CellPos *pts, int nPts) {
     SDL_RenderClear(graphic.renderer);
     SDL_RenderCopy(graphic.renderer, graphic.texture, NULL, NULL);
     if (game.state == GAME_PLAYING){
@@ -409,13 +340,8 @@ void drawTable(Game &game, const Graphic &graphic, const vector<SDL_Rect> rects,
         }
     }
 
-    if (!game.pts.empty()) {
-        for (int i=0; i<game.pts.size()-1; i++){
-            SDL_RenderDrawLine(graphic.renderer, game.pts[i].i, game.pts[i].j, game.pts[i+1].i, game.pts[i+1].j);
-        }
-        game.pts.clear();
-        SDL_RenderPresent(graphic.renderer);
-        SDL_Delay(500);
+    for (int i=0; i<nPts-1; i++){
+        SDL_RenderDrawLine(graphic.renderer, pts[i].i, pts[i].j, pts[i+1].i, pts[i+1].j);
     }
 
     SDL_RenderPresent(graphic.renderer);
@@ -424,269 +350,83 @@ void drawTable(Game &game, const Graphic &graphic, const vector<SDL_Rect> rects,
 void updateGame(Game &game, const SDL_Event &event, Audio &audio){
     if (game.state != GAME_PLAYING) return;
 
-    if (event.type != SDL_MOUSEBUTTONDOWN) return;
-
-    SDL_MouseButtonEvent mouse=event.button;
-    int square=WINDOW_SQUARE_WIDTH+2;
-    if (!((square<=mouse.x && mouse.x<square*(DEFAULT_COLS-1)) &&
-          (square+30<=mouse.y && mouse.y<=square*(DEFAULT_ROWS-1)+30))){
-        return;
-    }
-
-    CellPos pos = (CellPos) {(mouse.y-30)/square, (mouse.x)/square};
-    CellState state = game.cells[pos.i][pos.j].state;
-    if (state==CELL_EATEN || state==CELL_BLACK){
+    CellPos pos;
+    if (!getCellPos(event, pos) || !canSelect(game, pos)){
         return;
     }
-    processGame(game, pos, audio);
-}
 
-void processGame(Game &game, CellPos &pos, Audio &audio){
-    int rows=DEFAULT_ROWS-2;
-    int cols=DEFAULT_COLS-2;
-    bool check=false;
-    for (int i1=1; i1<=rows; i1++){
-    for (int j1=1; j1<=cols; j1++){
-        for (int i2=1; i2<=rows; i2++){
-        for (int j2=1; j2<=cols; j2++){
-            if ( (i1 != i2 || j1 != j2) && (game.cells[i1][j1].state == CELL_WHITE && game.cells[i2][j2].state == CELL_WHITE) ){
-                game.cells[i1][j1].state = CELL_BLACK;
-                game.cells[i2][j2].state = CELL_BLACK;
-                CellPos pos1 = (CellPos) {i1, j1};
-                CellPos pos2 = (CellPos) {i2, j2};
-                if (checkGame(game, pos1, pos2) == true) {
-                    game.pts.clear();
-                    check=true;
-                }
-                game.cells[i1][j1].state = CELL_WHITE;
-                game.cells[i2][j2].state = CELL_WHITE;
-            }
-        }
-        }
-    }
-    }
-    if (!check) resetGame(game.cells);
-
-
-    int maxVal=(game.nRows-2)*(game.nCols-2);
-    CellPos last = game.lastPos;
-    game.cells[pos.i][pos.j].state = CELL_BLACK;
-    if (last.i == 0) {
-        game.lastPos = pos;
-        return;
-    }
-
-    if (checkGame(game, last, pos)) {
-        game.cells[last.i][last.j].state = CELL_EATEN;
-        game.cells[pos.i][pos.j].state = CELL_EATEN;
-        game.nEaten+=2;
+    MoveResult result = processGame(game, pos);
+    if (result == MOVE_CORRECT){
         Mix_PlayChannelTimed(-1, audio.correct, 1, 1000);
     }
-    else {
-        game.cells[last.i][last.j].state = CELL_WHITE;
-        game.cells[pos.i][pos.j].state = CELL_WHITE;
+    if (result == MOVE_INCORRECT){
         Mix_PlayChannelTimed(-1, audio.incorrect, 1, 500);
     }
-
-    game.lastPos.i=0;
-    if (game.nEaten == maxVal){
-        game.state=GAME_WON;
-        return;
-    }
-
-
 }
 
-bool checkGame(Game &game, CellPos &pos1, CellPos &pos2){
-    game.pts.clear();
-    if (game.cells[pos1.i][pos1.j].value != game.cells[pos2.i][pos2.j].value) {
-        return false;
-    }
-    if (check1Line(game.cells, pos1, pos2)){
-        game.pts.push_back(getPoint(pos1.i, pos1.j));
-        game.pts.push_back(getPoint(pos2.i, pos2.j));
-        return true;
-    }
-
-    if (check2Lines(game.cells, pos1, pos2) == 1){
-        game.pts.push_back(getPoint(pos1.i, pos1.j));
-        game.pts.push_back(getPoint(pos1.i, pos2.j));
-        game.pts.push_back(getPoint(pos2.i, pos2.j));
-        return true;
-    }
-
-    if (check2Lines(game.cells, pos1, pos2) == 2){
-        game.pts.push_back(getPoint(pos1.i, pos1.j));
-        game.pts.push_back(getPoint(pos2.i, pos1.j));
-        game.pts.push_back(getPoint(pos2.i, pos2.j));
-        return true;
-    }
-
-    int j=check3LinesX(game.cells, pos1, pos2);
-    if (j!=-1) {
-        game.pts.push_back(getPoint(pos1.i, pos1.j));
-        game.pts.push_back(getPoint(pos1.i, j));
-        game.pts.push_back(getPoint(pos2.i, j));
-        game.pts.push_back(getPoint(pos2.i, pos2.j));
-        return true;
-    }
+bool getCellPos(const SDL_Event &event, CellPos &pos){
+    if (event.type != SDL_MOUSEBUTTONDOWN) return false;
 
-    int i=check3LinesY(game.cells, pos1, pos2);
-    if (i!=-1) {
-        game.pts.push_back(getPoint(pos1.i, pos1.j));
-        game.pts.push_back(getPoint(i, pos1.j));
-        game.pts.push_back(getPoint(i, pos2.j));
-        game.pts.push_back(getPoint(pos2.i, pos2.j));
-        return true;
+    SDL_MouseButtonEvent mouse=event.button;
+    int square=WINDOW_SQUARE_WIDTH+2;
+    if (!((square<=mouse.x && mouse.x<square*(DEFAULT_COLS-1)) &&
+          (square+30<=mouse.y && mouse.y<=square*(DEFAULT_ROWS-1)+30))){
+        return false;
     }
 
-    return false;
-}
-
-CellPos getPoint(int &i, int &j){
-    CellPos point;
-    point.i = j*52+26;
-    point.j = i*52+26+30;
-    return point;
+    pos = (CellPos) {(mouse.y-30)/square, (mouse.x)/square};
+    return true;
 }
 
-/// Đi theo đường chữ I
-bool check1Line(Table &cells, CellPos &pos1, CellPos &pos2){
-    if (pos1.i != pos2.i && pos1.j != pos2.j) return false;
-
-    if (pos1.i==pos2.i){
-        int i=pos1.i;
-        if (pos1.j<pos2.j){
-            for (int j=pos1.j; j<=pos2.j; j++){
-                if (cells[i][j].state == CELL_WHITE ) return false;
-            }
-            return true;
-        }
-        else {
-            for (int j=pos2.j; j<=pos1.j; j++){
-                if (cells[i][j].state == CELL_WHITE) return false;
-            }
-            return true;
-        }
+/// Chế độ hai luồng: processGame chạy trên luồng riêng, luồng này chỉ nhận click và vẽ bản chụp mới nhất
+bool runThreaded(const Graphic &graphic, const vector<SDL_Rect> &rects, Text &text, Audio &audio,
+                 int nRows, int nCols, int nSquares){
+    LogicThread logic;
+    if (!startLogic(logic, nRows, nCols, nSquares)){
+        err("Tạo luồng xử lý thất bại. Hãy kiểm tra lại.");
+        return false;
     }
 
-    if (pos1.j==pos2.j){
-        int j=pos1.j;
-        if (pos1.i<pos2.i){
-            for (int i=pos1.i; i<=pos2.i; i++){
-                if (cells[i][j].state == CELL_WHITE) return false;
+    bool quit=false;
+    SDL_Event event;
+    MoveEffect effect, line;
+    bool hasLine = false;
+    Uint32 lineUntil = 0;
+    while (!quit){
+        // Lấy hết hiệu ứng trước để bản chụp chắc chắn đã có các nước đi đó
+        while (popQueue(logic.effects, effect)){
+            if (effect.result == MOVE_CORRECT){
+                Mix_PlayChannelTimed(-1, audio.correct, 1, 1000);
+                line      = effect;
+                hasLine   = true;
+                lineUntil = SDL_GetTicks() + LINE_TIME;
             }
-            return true;
-        }
-        else {
-            for (int i=pos2.i; i<=pos1.i; i++){
-                if (cells[i][j].state == CELL_WHITE) return false;
+            if (effect.result == MOVE_INCORRECT){
+                Mix_PlayChannelTimed(-1, audio.incorrect, 1, 500);
             }
-            return true;
         }
-    }
-    return true;
-}
 
-/// Đi theo đường chữ L
-int check2Lines(Table &cells, CellPos &pos1, CellPos &pos2){
-    CellPos point1 = (CellPos) {pos1.i, pos2.j},
-            point2 = (CellPos) {pos2.i, pos1.j};
-    if (check1Line(cells, pos1, point1) && check1Line(cells, pos2, point1)) return 1;
-    if (check1Line(cells, pos1, point2) && check1Line(cells, pos2, point2)) return 2;
-    return -1;
-}
-
-/// Đi theo đường chữ Z hoặc U
-int check3LinesX(Table &cells, CellPos &pos1, CellPos &pos2){
-    CellPos pMax=pos1,
-            pMin=pos2;
-    if (pos1.j<pos2.j){
-        pMax=pos2;
-        pMin=pos1;
-    }
-
-    for (int j=pMin.j+1; j<pMax.j; j++){               // Đi chữ Z
-        CellPos point1=(CellPos) {pMin.i, j},
-                point2=(CellPos) {pMax.i, j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return j;
-    }
-
-    for (int j=pMin.j-1; j>=0; j--){                    // Đi chữ U
-        CellPos point1=(CellPos) {pMin.i, j},
-                point2=(CellPos) {pMax.i, j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return j;
-    }
-    for (int j=pMax.j+1; j<DEFAULT_COLS; j++){          // Đi chữ U
-        CellPos point1=(CellPos) {pMin.i, j},
-                point2=(CellPos) {pMax.i, j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return j;
-    }
-    return -1;
-}
-
-int check3LinesY(Table &cells, CellPos &pos1, CellPos &pos2){
-    CellPos pMax=pos1,
-            pMin=pos2;
-    if (pos1.i<pos2.i){
-        pMax=pos2;
-        pMin=pos1;
-    }
-
-    for (int i=pMin.i+1; i<pMax.i; i++){               // Đi chữ Z
-        CellPos point1=(CellPos) {i, pMin.j},
-                point2=(CellPos) {i, pMax.j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return i;
-    }
-
-    for (int i=pMin.i-1; i>=0; i--){                    // Đi chữ U
-        CellPos point1=(CellPos) {i, pMin.j},
-                point2=(CellPos) {i, pMax.j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return i;
-    }
-    for (int i=pMax.i+1; i<DEFAULT_ROWS; i++){          // Đi chữ U
-        CellPos point1=(CellPos) {i, pMin.j},
-                point2=(CellPos) {i, pMax.j};
-        if (check1Line(cells, pMin, point1) &&
-            check1Line(cells, point1, point2) &&
-            check1Line(cells, point2, pMax)) return i;
-    }
-    return -1;
-}
-
-void resetGame(Table &cells){
-    vector<int> num(DEFAULT_SQUARES, 0);
-    for (int i=1; i<DEFAULT_ROWS-1; i++){
-        for (int j=1; j<DEFAULT_COLS-1; j++){
-            if (cells[i][j].state == CELL_WHITE){
-                num[cells[i][j].value-1]++;
-            }
+        // Đường nối hiện trong LINE_TIME ms mà không chặn vòng lặp; bàn cờ đổi thì bỏ luôn
+        int seq;
+        const Game &snapshot = latestSnapshot(logic.snapshots, seq);
+        if (hasLine && (line.seq != seq || SDL_TICKS_PASSED(SDL_GetTicks(), lineUntil))){
+            hasLine = false;
         }
-    }
+        drawTable(snapshot, graphic, rects, text, hasLine ? line.pts : NULL, hasLine ? line.nPts : 0);
 
-    int value,
-        nSquares=DEFAULT_SQUARES;
-    for (int i=1; i<DEFAULT_ROWS-1; i++){
-        for (int j=1; j<DEFAULT_COLS-1; j++){
-            if (cells[i][j].state == CELL_WHITE){
-                do {
-                    value=rand()%nSquares+1;
-                } while (num[value-1]==0);
-                num[value-1]--;
-                cells[i][j].value=value;
+        while (SDL_PollEvent(&event) != 0){
+            if (event.type == SDL_QUIT){
+                quit=true;
+                break;
             }
+
+            CellPos pos;
+            if (getCellPos(event, pos)) sendClick(logic, pos);
         }
     }
+
+    stopLogic(logic);
+    return true;
 }
 
 void err(const string &mes){
@@ -0,0 +1,623 @@
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <csignal>
+#include <thread>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "game.h"
+#include "latency.h"
+
+using namespace std;
+
+/// Server không giao diện (chỉ chạy trên Linux): mỗi dòng là một lệnh, mỗi lệnh nhận một dòng trả lời.
+///     NEW                 -> GAME <id>
+///     MOVE <id> <i> <j>   -> SELECTED | CORRECT | INCORRECT | WON | INVALID
+///     BOARD <id>          -> BOARD <rows> <cols> <ô...>   (số dương: ô trắng, số âm: ô đang chọn, 0: ô đã ăn)
+///     END <id>            -> OK
+///     STATS               -> STATS <số ván đang chơi> <tổng số nước đi>
+/// Lệnh sai trả về ERROR <lý do>. Một kết nối chỉ dùng được những ván nó đã tạo.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int DEFAULT_PORT              =5050;
+const int DEFAULT_WORKERS           =4;
+const int MAX_EVENTS                =256;
+const int MAX_LINE                  =256;
+const int MAX_OUTPUT                =64*1024;       // Quá mức này thì ngừng đọc lệnh cho tới khi client đọc bớt
+const int REPORT_INTERVAL           =1000;          // ms
+const int ACCEPT_PAUSE              =100;           // ms, nghỉ nhận kết nối khi hết fd
+const int SESSION_CHUNK             =256;           // Số ván trong một khối cấp phát
+
+struct Session {
+    Game game;
+    int owner;                                      // fd của kết nối tạo ván, -1 nếu ô còn trống
+};
+
+/// Bàn cờ nằm liền trong Session, các Session cấp phát theo khối cố định nên không bao giờ bị dời chỗ.
+/// Ván kết thúc trả ô về freeSlots để ván sau dùng lại.
+struct SessionPool {
+    vector<Session*> chunks;
+    int nSlots;
+    vector<int> freeSlots;
+};
+
+struct Conn {
+    int fd;
+    string in;
+    string out;
+    vector<int> sessions;
+    int events;                                     // Các sự kiện đang đăng ký với epoll
+    int index;                                      // Vị trí trong Worker::conns
+};
+
+struct Worker {
+    int index;
+    int epfd;
+    int notify[2];                                  // Luồng chính gửi fd kết nối mới, -1 để báo dừng
+    thread runner;
+    vector<Conn*> conns;
+    SessionPool pool;
+    Latency latency;
+    atomic<int> nSessions;
+    atomic<unsigned long long> nMoves;
+    unsigned nextSeed;                              // Mỗi ván mới lấy một seed riêng từ đây
+    const vector<Worker*> *all;                     // Để lệnh STATS cộng số liệu của mọi luồng
+};
+
+struct Server {
+    int listenfd;
+    int spareFd;                                    // fd dự phòng, nhả ra khi hết fd để nhận rồi đóng kết nối
+    string unixPath;
+    vector<Worker*> workers;
+};
+
+volatile sig_atomic_t quitServer = 0;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool initServer(Server &server, int port, const string &unixPath, int nWorkers);
+void finalizeServer(Server &server);
+void runServer(Server &server);
+void onSignal(int);
+void raiseFileLimit();
+void acceptConns(Server &server, int &next, unsigned long long &pauseUntil);
+void reportStats(Server &server, LatencyReport &total, unsigned long long &lastReport);
+void err(const string &mes);
+bool setNonBlocking(int fd);
+
+void runWorker(Worker *w, int nWorkers);
+void stopWorker(Worker *w);
+void deleteWorker(Worker *w);
+void addConn(Worker &w, int fd);
+void closeConn(Worker &w, Conn *c);
+bool readConn(Worker &w, Conn &c, int nWorkers);
+void handleLines(Worker &w, Conn &c, int nWorkers);
+bool flushConn(Worker &w, Conn &c);
+void handleLine(Worker &w, Conn &c, const char *line, int nWorkers);
+
+int newSession(Worker &w, Conn &c, int nWorkers);
+Session* findSession(Worker &w, Conn &c, int id, int nWorkers);
+void endSession(Worker &w, int slot);
+Session& sessionAt(SessionPool &pool, int slot);
+void writeBoard(Game &game, string &out);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]){
+    int port     = DEFAULT_PORT,
+        nWorkers = DEFAULT_WORKERS;
+    string unixPath;
+
+    for (int i=1; i<argc; i++){
+        string arg = argv[i];
+        if (arg == "-p" && i+1<argc)      port = atoi(argv[++i]);
+        else if (arg == "-u" && i+1<argc) unixPath = argv[++i];
+        else if (arg == "-w" && i+1<argc) nWorkers = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Cách dùng: %s [-p cổng | -u đường_dẫn_socket] [-w số_luồng]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (nWorkers < 1) nWorkers = 1;
+
+    raiseFileLimit();
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    Server server;
+    if (!initServer(server, port, unixPath, nWorkers)) {
+        finalizeServer(server);
+        return EXIT_FAILURE;
+    }
+
+    runServer(server);
+
+    finalizeServer(server);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool initServer(Server &server, int port, const string &unixPath, int nWorkers){
+    server.listenfd = -1;
+    server.spareFd  = open("/dev/null", O_RDONLY);
+    server.unixPath = unixPath;
+
+    if (unixPath.empty()){
+        server.listenfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (server.listenfd < 0){
+            err("Tạo socket thất bại.");
+            return false;
+        }
+        int on = 1;
+        setsockopt(server.listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port        = htons(port);
+        if (bind(server.listenfd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            err("Không mở được cổng " + to_string(port) + ".");
+            return false;
+        }
+    }
+    else {
+        server.listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server.listenfd < 0){
+            err("Tạo socket thất bại.");
+            return false;
+        }
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (unixPath.size() >= sizeof(addr.sun_path)){
+            err("Đường dẫn " + unixPath + " quá dài.");
+            return false;
+        }
+        strcpy(addr.sun_path, unixPath.c_str());
+        unlink(unixPath.c_str());
+        if (bind(server.listenfd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            err("Không mở được " + unixPath + ".");
+            return false;
+        }
+    }
+
+    if (listen(server.listenfd, SOMAXCONN) != 0 || !setNonBlocking(server.listenfd)){
+        err("Không lắng nghe được kết nối.");
+        return false;
+    }
+
+    for (int i=0; i<nWorkers; i++){
+        Worker *w = new Worker;
+        w->index     = i;
+        w->epfd      = -1;
+        w->notify[0] = w->notify[1] = -1;
+        w->nSessions = 0;
+        w->pool.nSlots = 0;
+        w->all         = &server.workers;
+        w->nMoves    = 0;
+        w->nextSeed  = time(0)*nWorkers + i;
+        initLatency(w->latency);
+        server.workers.push_back(w);                // Thất bại giữa chừng thì finalizeServer vẫn dọn được
+
+        w->epfd = epoll_create1(0);
+        if (w->epfd < 0 || pipe(w->notify) != 0){
+            err("Tạo epoll thất bại.");
+            return false;
+        }
+        epoll_event ev;
+        ev.events   = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->notify[0], &ev);
+    }
+
+    for (int i=0; i<nWorkers; i++){
+        server.workers[i]->runner = thread(runWorker, server.workers[i], nWorkers);
+    }
+
+    printf("[server] %d luồng, đang lắng nghe %s\n", nWorkers,
+           unixPath.empty() ? ("cổng " + to_string(port)).c_str() : unixPath.c_str());
+    fflush(stdout);
+    return true;
+}
+
+/// Dừng hết các luồng xử lý trước rồi mới giải phóng, vì luồng nào cũng đọc Worker::all
+void finalizeServer(Server &server){
+    for (int i=0; i<(int) server.workers.size(); i++){
+        stopWorker(server.workers[i]);
+    }
+    for (int i=0; i<(int) server.workers.size(); i++){
+        deleteWorker(server.workers[i]);
+    }
+    server.workers.clear();
+
+    if (server.listenfd >= 0) close(server.listenfd);
+    if (server.spareFd >= 0) close(server.spareFd);
+    if (!server.unixPath.empty()) unlink(server.unixPath.c_str());
+}
+
+/// Luồng chính nhận kết nối mới, chia đều cho các luồng xử lý và in số liệu mỗi giây
+void runServer(Server &server){
+    int next = 0;
+    unsigned long long pauseUntil = 0;
+    unsigned long long lastReport = nowNs();
+    LatencyReport total;
+    clearReport(total);
+    unsigned long long totalStart = lastReport;
+
+    while (!quitServer){
+        if (nowNs() < pauseUntil){
+            poll(NULL, 0, ACCEPT_PAUSE);
+        }
+        else {
+            pollfd pfd = {server.listenfd, POLLIN, 0};
+            if (poll(&pfd, 1, REPORT_INTERVAL) > 0) acceptConns(server, next, pauseUntil);
+        }
+
+        if (nowNs() - lastReport >= REPORT_INTERVAL*1000000ULL) reportStats(server, total, lastReport);
+    }
+
+    reportStats(server, total, lastReport);                 // Phần lẻ từ lần báo cáo cuối tới lúc dừng
+    printf("[server] Tổng kết:\n");
+    printReport("server", total, (lastReport-totalStart)/1e9);
+}
+
+/// Lấy số liệu của mọi luồng từ lần báo cáo trước, in ra và cộng vào tổng
+void reportStats(Server &server, LatencyReport &total, unsigned long long &lastReport){
+    unsigned long long now = nowNs();
+    LatencyReport report;
+    clearReport(report);
+    int nSessions = 0;
+    for (int i=0; i<(int) server.workers.size(); i++){
+        collectLatency(server.workers[i]->latency, report);
+        nSessions += server.workers[i]->nSessions;
+    }
+    if (report.count > 0 || nSessions > 0){
+        printReport("server", report, (now-lastReport)/1e9, " | " + to_string(nSessions) + " ván");
+    }
+    mergeReport(total, report);
+    lastReport = now;
+}
+
+void acceptConns(Server &server, int &next, unsigned long long &pauseUntil){
+    int nWorkers = server.workers.size();
+    while (true){
+        int fd = accept(server.listenfd, NULL, NULL);
+        if (fd < 0){
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EMFILE && errno != ENFILE) return;
+
+            // Hết fd: kết nối vẫn nằm trong hàng đợi nên socket nghe luôn sẵn sàng đọc.
+            // Dùng fd dự phòng để nhận rồi đóng ngay, nếu không được thì tạm ngừng nhận.
+            if (server.spareFd >= 0){
+                close(server.spareFd);
+                fd = accept(server.listenfd, NULL, NULL);
+                if (fd >= 0) close(fd);
+                server.spareFd = open("/dev/null", O_RDONLY);
+                if (fd >= 0) continue;
+            }
+            fprintf(stderr, "[server] Hết file descriptor, tạm ngừng nhận kết nối\n");
+            pauseUntil = nowNs() + ACCEPT_PAUSE*1000000ULL;
+            return;
+        }
+
+        if (!setNonBlocking(fd)){
+            close(fd);
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (write(server.workers[next]->notify[1], &fd, sizeof(fd)) != sizeof(fd)){
+            close(fd);
+        }
+        next = (next+1) % nWorkers;
+    }
+}
+
+void onSignal(int){
+    quitServer = 1;
+}
+
+/// Nâng giới hạn số fd lên mức tối đa cho phép để giữ được hàng nghìn kết nối
+void raiseFileLimit(){
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_cur == lim.rlim_max) return;
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+}
+
+void err(const string &mes){
+    fprintf(stderr, "Lỗi: %s (%s)\n", mes.c_str(), strerror(errno));
+}
+
+bool setNonBlocking(int fd){
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Mỗi luồng có epoll, kết nối và các ván riêng, mỗi ván có bộ sinh số ngẫu nhiên riêng nên không cần khoá
+void runWorker(Worker *w, int nWorkers){
+    epoll_event events[MAX_EVENTS];
+    while (true){
+        int n = epoll_wait(w->epfd, events, MAX_EVENTS, -1);
+        for (int k=0; k<n; k++){
+            Conn *c = (Conn*) events[k].data.ptr;
+            if (c == NULL){
+                int fd;
+                if (read(w->notify[0], &fd, sizeof(fd)) != sizeof(fd)) continue;
+                if (fd < 0) return;                 // Luồng chính báo dừng
+                addConn(*w, fd);
+                continue;
+            }
+
+            bool ok = !(events[k].events & (EPOLLERR | EPOLLHUP)) || (events[k].events & EPOLLIN);
+            if (ok) ok = flushConn(*w, *c);
+            // Gửi hết trả lời mà vẫn còn lệnh đã nhận chưa xử lý thì xử lý tiếp, không đợi epoll báo lại
+            while (ok && c->out.size() < (size_t) MAX_OUTPUT){
+                ok = readConn(*w, *c, nWorkers) && flushConn(*w, *c);
+                if (c->in.find('\n') == string::npos) break;
+            }
+            if (!ok) closeConn(*w, c);
+        }
+    }
+}
+
+/// Luồng chính chỉ gọi sau khi đã ngừng nhận kết nối, nên -1 là giá trị cuối cùng trong ống
+void stopWorker(Worker *w){
+    if (!w->runner.joinable()) return;
+    int stop = -1;
+    if (write(w->notify[1], &stop, sizeof(stop)) != sizeof(stop)) err("Không báo dừng được luồng xử lý.");
+    w->runner.join();
+}
+
+/// Luồng xử lý đã dừng: đóng mọi kết nối còn lại và trả hết bộ nhớ
+void deleteWorker(Worker *w){
+    for (int i=0; i<(int) w->conns.size(); i++){
+        close(w->conns[i]->fd);
+        delete w->conns[i];
+    }
+    for (int i=0; i<(int) w->pool.chunks.size(); i++){
+        delete[] w->pool.chunks[i];
+    }
+    if (w->epfd >= 0)      close(w->epfd);
+    if (w->notify[0] >= 0) close(w->notify[0]);
+    if (w->notify[1] >= 0) close(w->notify[1]);
+    delete w;
+}
+
+void addConn(Worker &w, int fd){
+    Conn *c = new Conn;
+    c->fd        = fd;
+    c->events    = EPOLLIN;
+
+    epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = c;
+    if (epoll_ctl(w.epfd, EPOLL_CTL_ADD, fd, &ev) != 0){
+        close(fd);
+        delete c;
+        return;
+    }
+    c->index = w.conns.size();
+    w.conns.push_back(c);
+}
+
+void closeConn(Worker &w, Conn *c){
+    epoll_ctl(w.epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    for (int i=0; i<(int) c->sessions.size(); i++){
+        endSession(w, c->sessions[i]);
+    }
+    w.conns[c->index] = w.conns.back();
+    w.conns[c->index]->index = c->index;
+    w.conns.pop_back();
+    delete c;
+}
+
+/// Chỉ đọc tiếp khi hàng đợi trả lời còn chỗ, nên client gửi dồn mà không đọc cũng không làm bộ nhớ tăng mãi
+bool readConn(Worker &w, Conn &c, int nWorkers){
+    char buf[4096];
+    handleLines(w, c, nWorkers);
+    while (c.out.size() < (size_t) MAX_OUTPUT){
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0){
+            c.in.append(buf, n);
+            handleLines(w, c, nWorkers);
+            if (c.in.size() > (size_t) MAX_LINE && c.in.find('\n') == string::npos) return false;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    return true;
+}
+
+/// Xử lý các dòng đã nhận đủ, dừng lại nếu hàng đợi trả lời đã đầy
+void handleLines(Worker &w, Conn &c, int nWorkers){
+    size_t start = 0, end;
+    while (c.out.size() < (size_t) MAX_OUTPUT && (end = c.in.find('\n', start)) != string::npos){
+        if (end > start && c.in[end-1] == '\r') c.in[end-1] = '\0';
+        c.in[end] = '\0';
+        handleLine(w, c, c.in.c_str()+start, nWorkers);
+        start = end+1;
+    }
+    c.in.erase(0, start);
+}
+
+bool flushConn(Worker &w, Conn &c){
+    size_t sent = 0;
+    while (sent < c.out.size()){
+        ssize_t n = send(c.fd, c.out.data()+sent, c.out.size()-sent, MSG_NOSIGNAL);
+        if (n < 0){
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += n;
+    }
+    c.out.erase(0, sent);
+
+    int events = 0;
+    if (c.out.size() < (size_t) MAX_OUTPUT) events |= EPOLLIN;
+    if (!c.out.empty())                     events |= EPOLLOUT;
+    if (events != c.events){
+        epoll_event ev;
+        ev.events   = events;
+        ev.data.ptr = &c;
+        epoll_ctl(w.epfd, EPOLL_CTL_MOD, c.fd, &ev);
+        c.events = events;
+    }
+    return true;
+}
+
+void handleLine(Worker &w, Conn &c, const char *line, int nWorkers){
+    int id, i, j;
+    if (sscanf(line, "MOVE %d %d %d", &id, &i, &j) == 3){
+        Session *s = findSession(w, c, id, nWorkers);
+        if (s == NULL){
+            c.out += "ERROR session\n";
+            return;
+        }
+        CellPos pos = (CellPos) {i, j};
+        if (!canSelect(s->game, pos)){
+            c.out += "INVALID\n";
+            return;
+        }
+
+        unsigned long long start = nowNs();
+        MoveResult result = processGame(s->game, pos);
+        recordLatency(w.latency, nowNs()-start);
+        w.nMoves.fetch_add(1, memory_order_relaxed);
+
+        if (s->game.state == GAME_WON)  c.out += "WON\n";
+        else if (result == MOVE_CORRECT) c.out += "CORRECT\n";
+        else if (result == MOVE_INCORRECT) c.out += "INCORRECT\n";
+        else c.out += "SELECTED\n";
+        return;
+    }
+
+    if (sscanf(line, "BOARD %d", &id) == 1){
+        Session *s = findSession(w, c, id, nWorkers);
+        if (s == NULL){
+            c.out += "ERROR session\n";
+            return;
+        }
+        writeBoard(s->game, c.out);
+        return;
+    }
+
+    if (sscanf(line, "END %d", &id) == 1){
+        Session *s = findSession(w, c, id, nWorkers);
+        if (s == NULL){
+            c.out += "ERROR session\n";
+            return;
+        }
+        int slot = id / nWorkers;
+        for (int k=0; k<(int) c.sessions.size(); k++){
+            if (c.sessions[k] == slot){
+                c.sessions[k] = c.sessions.back();
+                c.sessions.pop_back();
+                break;
+            }
+        }
+        endSession(w, slot);
+        c.out += "OK\n";
+        return;
+    }
+
+    if (strcmp(line, "NEW") == 0){
+        int slot = newSession(w, c, nWorkers);
+        c.out += "GAME " + to_string(slot*nWorkers + w.index) + "\n";
+        return;
+    }
+
+    if (strcmp(line, "STATS") == 0){
+        int nSessions = 0;
+        unsigned long long nMoves = 0;
+        for (int k=0; k<(int) w.all->size(); k++){
+            nSessions += (*w.all)[k]->nSessions;
+            nMoves    += (*w.all)[k]->nMoves;
+        }
+        c.out += "STATS " + to_string(nSessions) + " " + to_string(nMoves) + "\n";
+        return;
+    }
+
+    c.out += "ERROR command\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int newSession(Worker &w, Conn &c, int nWorkers){
+    SessionPool &pool = w.pool;
+    int slot;
+    if (!pool.freeSlots.empty()){
+        slot = pool.freeSlots.back();
+        pool.freeSlots.pop_back();
+    }
+    else {
+        if (pool.nSlots == (int) pool.chunks.size()*SESSION_CHUNK){
+            pool.chunks.push_back(new Session[SESSION_CHUNK]);
+        }
+        slot = pool.nSlots++;
+    }
+
+    Session &s = sessionAt(pool, slot);
+    initGame(s.game, DEFAULT_ROWS, DEFAULT_COLS, DEFAULT_SQUARES, w.nextSeed);
+    w.nextSeed += nWorkers;                         // Seed của các luồng khác nhau không bao giờ trùng
+    s.owner = c.fd;
+    c.sessions.push_back(slot);
+    w.nSessions++;
+    return slot;
+}
+
+Session* findSession(Worker &w, Conn &c, int id, int nWorkers){
+    if (id < 0 || id % nWorkers != w.index) return NULL;
+    int slot = id / nWorkers;
+    if (slot >= w.pool.nSlots) return NULL;
+    Session &s = sessionAt(w.pool, slot);
+    if (s.owner != c.fd) return NULL;
+    return &s;
+}
+
+void endSession(Worker &w, int slot){
+    sessionAt(w.pool, slot).owner = -1;
+    w.pool.freeSlots.push_back(slot);
+    w.nSessions--;
+}
+
+Session& sessionAt(SessionPool &pool, int slot){
+    return pool.chunks[slot/SESSION_CHUNK][slot%SESSION_CHUNK];
+}
+
+void writeBoard(Game &game, string &out){
+    char buf[16];
+    out += "BOARD " + to_string(game.nRows) + " " + to_string(game.nCols);
+    for (int i=0; i<game.nRows; i++){
+        for (int j=0; j<game.nCols; j++){
+            Cell &cell = game.cells[i][j];
+            int value = cell.state == CELL_WHITE ? cell.value :
+                        cell.state == CELL_BLACK ? -cell.value : 0;
+            snprintf(buf, sizeof(buf), " %d", value);
+            out += buf;
+        }
+    }
+    out += "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////